@@ -1,30 +1,214 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <limits.h>
 #include <time.h>
 #include <unistd.h>
+#include <omp.h>
+#include <mpi.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 #define POP_SIZE 250 // number of chromosomes in a population
 #define END_GEN 1000000
 #define MUTATION_PROB 0.25
 #define NO_IMPROVEMENT 10000
 #define TOURNAMENT_SIZE 5
+#define CHECKPOINT_INTERVAL 64 // genes between the next-fit checkpoints kept with each chromosome
+#define LANES 16 // chromosomes evaluated side by side by batched next-fit
+#define BENCHMARK_SEED 12345 // seed of benchmark runs and generated instances unless one is given
+#define BENCHMARK_GENERATIONS 1000 // generations of a benchmark run unless a count is given
+#define MIGRATION_INTERVAL 50 // generations between migrations from one island (MPI rank) to another
+#define MIGRANTS 5 // number of top chromosomes sent to the next island on each migration
+#define MIGRATION_TAG 1
+
+// Island topologies that migrants travel over
+#define TOPOLOGY_RING 0
+#define TOPOLOGY_RANDOM 1
+
+// Phases of a generation that benchmark runs time
+#define PHASE_SELECTION 0
+#define PHASE_CROSSOVER 1
+#define PHASE_MUTATION 2
+#define PHASE_EVALUATION 3
+#define PHASE_SURVIVORS 4
+#define PHASES 5
+
+// Contains a problem instance. Items are remapped at load time to dense IDs, one per
+// distinct weight in ascending order of weight, and chromosomes hold these IDs.
+struct instance {
+	int max_weight; // bin capacity
+	int size; // number of genes in a chromosome (items to organize)
+	int types; // number of distinct item weights
+	int *weights; // weight of each item ID
+	int *items; // ID of every item in file order
+	int l1; // lower bound on the number of bins from the total weight
+	int l2; // Martello-Toth lower bound on the number of bins
+	int lower_bound; // best of the lower bounds, no packing can use fewer bins
+};
+typedef struct instance instance_t;
+
+// Contains the settings of a run, shared by every instance it solves
+struct options {
+	uint64_t seed;
+	int threads; // threads evolving each population
+	int generations; // generation budget per instance
+	double time_limit; // seconds per instance, none when 0
+	int topology;
+	int migration_interval;
+	int migrants;
+	int benchmark; // run exactly the generation budget and time every phase
+	char *decoder_name;
+	char *simd_name;
+};
+typedef struct options options_t;
+
+// Contains the outcome of solving one instance
+struct result {
+	int bins; // fewest bins found
+	int generations;
+	long long evaluations; // chromosomes evaluated
+	double runtime; // seconds
+	char *reason; // why the solver stopped
+	double phase_time[PHASES]; // thread-seconds spent in each phase (benchmark runs only)
+	int *curve; // best after the initial population and every generation (benchmark runs only)
+};
+typedef struct result result_t;
+
+// Contains a chromosome's gene ordering alongside its fitness, which is only
+// computed once when the chromosome is created. Next-fit state (bins, fill) is checkpointed
+// before every CHECKPOINT_INTERVAL-th gene so evaluation can resume past an unchanged head.
+struct chromosome {
+	int *genes;
+	int *checkpoints; // bins and fill before genes 0, CHECKPOINT_INTERVAL, 2 * CHECKPOINT_INTERVAL, ...
+	int dirty; // first gene changed since the checkpoints were recorded
+	int birth; // generation the chromosome was created in
+	int fitness;
+};
+typedef struct chromosome chromosome_t;
+
+// Contains the state of one xoshiro256** random number stream. Every thread owns
+// its own stream, aligned to a cache line so neighbouring streams never share one.
+struct rng {
+	uint64_t s[4];
+} __attribute__((aligned(64)));
+typedef struct rng rng_t;
+
+// Rotates the bits of x left by k
+static inline uint64_t rotl(uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+// Advances a splitmix64 generator, used only to expand a seed into stream state
+uint64_t splitmix64(uint64_t *x) {
+	uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+// Seeds a stream deterministically from the run seed and the stream (thread) number,
+// so a run is reproducible for a given seed and thread count
+void rng_seed(rng_t *rng, uint64_t seed, int stream) {
+	uint64_t x = seed ^ (0xd1b54a32d192ed03ULL * (uint64_t) (stream + 1));
+	for (int i = 0; i < 4; i++) {
+		rng->s[i] = splitmix64(&x);
+	}
+}
+
+// Returns the next 64 random bits of a xoshiro256** stream
+uint64_t rng_next(rng_t *rng) {
+	uint64_t *s = rng->s;
+	uint64_t result = rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+
+	return result;
+}
 
-int size; // number of genes in a chromosome
-int max_weight;
+// Returns a random double in [0, 1)
+double random_double(rng_t *rng) {
+	return (rng_next(rng) >> 11) * 0x1.0p-53;
+}
 
 // Returns a random integer from 0 to max (inclusive) with uniform distribution
-int random_num(int max) {
-	unsigned long num_bins = (unsigned long) max + 1;
-	unsigned long num_rand = (unsigned long) RAND_MAX + 1;
-	unsigned long bin_size = num_rand / num_bins;
-	unsigned long defect = num_rand % num_bins;
-	long x;
+int random_num(rng_t *rng, int max) {
+	uint64_t num_bins = (uint64_t) max + 1;
+	uint64_t defect = (UINT64_MAX - num_bins + 1) % num_bins; // 2^64 % num_bins
+	uint64_t x;
 	do {
-		x = random();
-	} while (num_rand - defect <= (unsigned long)x);
+		x = rng_next(rng);
+	} while (x < defect);
+
+	return x % num_bins;
+}
+
+// Contains per-thread working memory for crossover and the decoders, sized to the instance
+// once so that making and evaluating a chromosome never allocates. Aligned to a cache line
+// since the phase timers are written by their thread throughout a generation.
+struct scratch {
+	double phase_time[PHASES]; // seconds this thread spent in each phase
+	int *counts; // occurrences of each item ID still to be placed (crossover), all zero between calls
+	int leaves; // number of leaves in the segment tree, at least one per possible bin
+	int *tree; // segment tree over bin residual capacities (first-fit)
+	int *residual; // treap nodes, one per bin, ordered by residual capacity (best-fit)
+	int *left;
+	int *right;
+	uint32_t *priority;
+	int *staged; // weights of a group of chromosomes' next genes, interleaved by lane (batched next-fit)
+} __attribute__((aligned(64)));
+typedef struct scratch scratch_t;
+
+// Decodes an arrangement of item IDs into a packing, returning the number of bins
+typedef int (*decoder_t)(scratch_t *scratch, instance_t *instance, int *genes);
+
+// Allocates a thread's working memory for chromosomes of an instance
+void scratch_init(scratch_t *scratch, instance_t *instance) {
+	int size = instance->size;
+	memset(scratch->phase_time, 0, sizeof(scratch->phase_time));
+	scratch->counts = calloc(instance->types, sizeof(int));
+	scratch->leaves = 1;
+	while (scratch->leaves < size) {
+		scratch->leaves *= 2;
+	}
+	scratch->tree = malloc(2 * scratch->leaves * sizeof(int));
+	scratch->residual = malloc(size * sizeof(int));
+	scratch->left = malloc(size * sizeof(int));
+	scratch->right = malloc(size * sizeof(int));
+	scratch->priority = malloc(size * sizeof(uint32_t));
+	scratch->staged = aligned_alloc(64, CHECKPOINT_INTERVAL * LANES * sizeof(int));
+
+	// Treap priorities only need to look random, so they are fixed per node
+	uint64_t x = 0;
+	for (int i = 0; i < size; i++) {
+		scratch->priority[i] = splitmix64(&x) >> 32;
+	}
+}
+
+// Frees a thread's working memory
+void scratch_free(scratch_t *scratch) {
+	free(scratch->counts);
+	free(scratch->tree);
+	free(scratch->residual);
+	free(scratch->left);
+	free(scratch->right);
+	free(scratch->priority);
+	free(scratch->staged);
+}
 
-	return x/bin_size;
+// Adds the time since mark to a phase of a thread's profile and restarts the mark
+void lap(scratch_t *scratch, int phase, double *mark) {
+	double now = omp_get_wtime();
+	scratch->phase_time[phase] += now - *mark;
+	*mark = now;
 }
 
 // Swap two elements from an array of ints
@@ -58,124 +242,391 @@ void print2DArray(int **array, int size) {
 }
 
 // Applies greedy algorithm for determining fitness (number of bins) for
-// current array elelement arrangement sequentially
-int fitness(int *array, int size, int max_weight) {
+// current array elelement arrangement sequentially, only ever filling the last opened bin
+int next_fit(scratch_t *scratch, instance_t *instance, int *genes) {
+	int *weights = instance->weights;
+	int max_weight = instance->max_weight;
 	int bins = 1;
 	int weight = 0;
-	int j = 0;
 
-	for (int i = 0; i < size; i++) {
-		if (weight + array[i] > max_weight) {
+	for (int i = 0; i < instance->size; i++) {
+		if (weight + weights[genes[i]] > max_weight) {
 			bins++;
 			weight = 0;
-			weight += array[i];
+			weight += weights[genes[i]];
 		} else {
-			weight += array[i];
+			weight += weights[genes[i]];
 		}
 	}
 	return bins;
 }
 
-// Employs the modern Fisher-Yates shuffle algorithm to shuffle an 
-// array of integers in-place with all permutations equally likely.
-void shuffle(int *array, int size) {
-	// Select random index [0, size-1] to swap with i
-	for (int i = size-1; i > 0; i--) {
-		swap(array, i, random_num(i)); // swap i and j elements of the array in-place
+// Places each item into the first (lowest numbered) bin it fits in. A segment tree holding
+// the largest residual capacity of each range of bins finds that bin in O(log bins).
+int first_fit(scratch_t *scratch, instance_t *instance, int *genes) {
+	int *weights = instance->weights;
+	int max_weight = instance->max_weight;
+	int leaves = scratch->leaves;
+	int *tree = scratch->tree;
+	int bins = 0;
+
+	// Every bin starts out empty, unopened bins simply have not been used yet
+	for (int node = 1; node < 2 * leaves; node++) {
+		tree[node] = max_weight;
 	}
+
+	for (int i = 0; i < instance->size; i++) {
+		int weight = weights[genes[i]];
+		int node = 1;
+
+		// Descend to the leftmost bin with enough room. An item heavier than a bin gets a new bin of its own.
+		if (tree[1] < weight) {
+			node = leaves + bins;
+		} else {
+			while (node < leaves) {
+				node = tree[2 * node] >= weight ? 2 * node : 2 * node + 1;
+			}
+		}
+		if (node - leaves + 1 > bins) {
+			bins = node - leaves + 1;
+		}
+
+		// Fill the bin and update the residual capacities above it
+		tree[node] = tree[node] > weight ? tree[node] - weight : 0;
+		for (node /= 2; node >= 1; node /= 2) {
+			tree[node] = tree[2 * node] > tree[2 * node + 1] ? tree[2 * node] : tree[2 * node + 1];
+		}
+	}
+	return bins;
 }
 
-int **crossover(int *chromosomeA, int *chromosomeB, int size) {
-	// Allocating 2D offspring array
-	int **offspring = malloc(2 * sizeof(int *));
-	for (int i = 0; i < 2; i++) {
-		offspring[i] = malloc(size * sizeof(int));
+// Splits treap t into the bins with a residual capacity below key (lower) and the rest (upper)
+void treap_split(scratch_t *scratch, int t, int key, int *lower, int *upper) {
+	if (t < 0) {
+		*lower = -1;
+		*upper = -1;
+	} else if (scratch->residual[t] < key) {
+		*lower = t;
+		treap_split(scratch, scratch->right[t], key, &scratch->right[t], upper);
+	} else {
+		*upper = t;
+		treap_split(scratch, scratch->left[t], key, lower, &scratch->left[t]);
 	}
-	
+}
 
-	// Generate random crossover point
-	int index = 1 + random_num(size-1 - 1);
-	//printf("Crossover point: %d\n", index);
-	
-	int seen_numbers_B[200];
-	int seen_numbers_A[200];
+// Joins two treaps where every residual capacity in a is at most those in b
+int treap_merge(scratch_t *scratch, int a, int b) {
+	if (a < 0) {
+		return b;
+	}
+	if (b < 0) {
+		return a;
+	}
+	if (scratch->priority[a] > scratch->priority[b]) {
+		scratch->right[a] = treap_merge(scratch, scratch->right[a], b);
+		return a;
+	}
+	scratch->left[b] = treap_merge(scratch, a, scratch->left[b]);
+	return b;
+}
+
+// Removes the bin with the smallest residual capacity from treap t, storing it in min
+int treap_pop_min(scratch_t *scratch, int t, int *min) {
+	if (scratch->left[t] < 0) {
+		*min = t;
+		return scratch->right[t];
+	}
+	scratch->left[t] = treap_pop_min(scratch, scratch->left[t], min);
+	return t;
+}
 
-	int head_numbers_A[200];
-	int head_numbers_B[200];
+// Places each item into the fullest bin it still fits in. Bins are kept in a treap (a balanced
+// binary search tree) ordered by residual capacity, so that bin is found in O(log bins).
+int best_fit(scratch_t *scratch, instance_t *instance, int *genes) {
+	int *weights = instance->weights;
+	int max_weight = instance->max_weight;
+	int root = -1;
+	int bins = 0;
+
+	for (int i = 0; i < instance->size; i++) {
+		int weight = weights[genes[i]];
+		int lower, upper, bin;
+
+		// The smallest residual capacity that still holds the item is the minimum of the upper treap
+		treap_split(scratch, root, weight, &lower, &upper);
+		if (upper < 0) {
+			bin = bins++;
+			scratch->residual[bin] = max_weight;
+		} else {
+			upper = treap_pop_min(scratch, upper, &bin);
+		}
+		root = treap_merge(scratch, lower, upper);
+
+		// Fill the bin and put it back in order of its new residual capacity
+		scratch->residual[bin] = scratch->residual[bin] > weight ? scratch->residual[bin] - weight : 0;
+		scratch->left[bin] = -1;
+		scratch->right[bin] = -1;
+		treap_split(scratch, root, scratch->residual[bin], &lower, &upper);
+		root = treap_merge(scratch, treap_merge(scratch, lower, bin), upper);
+	}
+	return bins;
+}
 
+// Runs the next-fit recurrence for LANES chromosomes at once over steps genes, whose weights are
+// staged interleaved by lane (staged[step * LANES + lane]). A lane only advances while it has
+// genes remaining, the rest of its staged weights are zero.
+typedef void (*lanes_kernel_t)(int *staged, int steps, int max_weight, int *bins, int *weight, int *remaining);
+
+// Portable version of the batched next-fit recurrence, written branch-free per lane
+void next_fit_lanes_scalar(int *staged, int steps, int max_weight, int *bins, int *weight, int *remaining) {
+	for (int step = 0; step < steps; step++) {
+		for (int lane = 0; lane < LANES; lane++) {
+			int item = staged[step * LANES + lane];
+			int sum = weight[lane] + item;
+			int full = (remaining[lane] > 0) & (sum > max_weight);
+			bins[lane] += full;
+			weight[lane] = full ? item : sum;
+			remaining[lane]--;
+		}
+	}
+}
 
-	// Set heads of arrays
-	for (int i = 0; i < index; i++) {
-		offspring[0][i] = chromosomeA[i]; // Head from A - takes tail from B
-		offspring[1][i] = chromosomeB[i]; // Head from B - takes tail from A
+#if defined(__x86_64__) || defined(__i386__)
+// Batched next-fit recurrence with AVX2, the 16 lanes as two vectors of 8
+__attribute__((target("avx2")))
+void next_fit_lanes_avx2(int *staged, int steps, int max_weight, int *bins, int *weight, int *remaining) {
+	__m256i capacity = _mm256_set1_epi32(max_weight);
+	__m256i zero = _mm256_setzero_si256();
+	__m256i one = _mm256_set1_epi32(1);
+	__m256i bins_lo = _mm256_loadu_si256((__m256i *) bins);
+	__m256i bins_hi = _mm256_loadu_si256((__m256i *) (bins + 8));
+	__m256i weight_lo = _mm256_loadu_si256((__m256i *) weight);
+	__m256i weight_hi = _mm256_loadu_si256((__m256i *) (weight + 8));
+	__m256i remaining_lo = _mm256_loadu_si256((__m256i *) remaining);
+	__m256i remaining_hi = _mm256_loadu_si256((__m256i *) (remaining + 8));
+
+	for (int step = 0; step < steps; step++) {
+		__m256i item_lo = _mm256_load_si256((__m256i *) (staged + step * LANES));
+		__m256i item_hi = _mm256_load_si256((__m256i *) (staged + step * LANES + 8));
+		__m256i sum_lo = _mm256_add_epi32(weight_lo, item_lo);
+		__m256i sum_hi = _mm256_add_epi32(weight_hi, item_hi);
+
+		// All ones in the lanes whose last bin is full and open a new bin
+		__m256i full_lo = _mm256_and_si256(_mm256_cmpgt_epi32(sum_lo, capacity), _mm256_cmpgt_epi32(remaining_lo, zero));
+		__m256i full_hi = _mm256_and_si256(_mm256_cmpgt_epi32(sum_hi, capacity), _mm256_cmpgt_epi32(remaining_hi, zero));
+
+		bins_lo = _mm256_sub_epi32(bins_lo, full_lo);
+		bins_hi = _mm256_sub_epi32(bins_hi, full_hi);
+		weight_lo = _mm256_blendv_epi8(sum_lo, item_lo, full_lo);
+		weight_hi = _mm256_blendv_epi8(sum_hi, item_hi, full_hi);
+		remaining_lo = _mm256_sub_epi32(remaining_lo, one);
+		remaining_hi = _mm256_sub_epi32(remaining_hi, one);
 	}
 
-	// Create associative arrays for numbers
-	for (int i = 0; i < 200; i++) {
-		seen_numbers_A[i] = 0;
-		head_numbers_A[i] = 0;
+	_mm256_storeu_si256((__m256i *) bins, bins_lo);
+	_mm256_storeu_si256((__m256i *) (bins + 8), bins_hi);
+	_mm256_storeu_si256((__m256i *) weight, weight_lo);
+	_mm256_storeu_si256((__m256i *) (weight + 8), weight_hi);
+	_mm256_storeu_si256((__m256i *) remaining, remaining_lo);
+	_mm256_storeu_si256((__m256i *) (remaining + 8), remaining_hi);
+}
 
-		seen_numbers_B[i] = 0;
-		head_numbers_B[i] = 0;
+// Batched next-fit recurrence with AVX-512, all 16 lanes in one vector
+__attribute__((target("avx512f")))
+void next_fit_lanes_avx512(int *staged, int steps, int max_weight, int *bins, int *weight, int *remaining) {
+	__m512i capacity = _mm512_set1_epi32(max_weight);
+	__m512i zero = _mm512_setzero_si512();
+	__m512i one = _mm512_set1_epi32(1);
+	__m512i bins_v = _mm512_loadu_si512(bins);
+	__m512i weight_v = _mm512_loadu_si512(weight);
+	__m512i remaining_v = _mm512_loadu_si512(remaining);
+
+	for (int step = 0; step < steps; step++) {
+		__m512i item = _mm512_load_si512(staged + step * LANES);
+		__m512i sum = _mm512_add_epi32(weight_v, item);
+
+		// Lanes whose last bin is full and open a new bin
+		__mmask16 active = _mm512_cmpgt_epi32_mask(remaining_v, zero);
+		__mmask16 full = _mm512_mask_cmpgt_epi32_mask(active, sum, capacity);
+
+		bins_v = _mm512_mask_add_epi32(bins_v, full, bins_v, one);
+		weight_v = _mm512_mask_blend_epi32(full, sum, item);
+		remaining_v = _mm512_sub_epi32(remaining_v, one);
 	}
 
-	// Count all the number apperances in ChromosomeB's entire array
-	for (int i = 0; i < size; i++) {
-		seen_numbers_A[chromosomeA[i]]++; // Takes tail from B
-		//printf("chromosomeA[i] = %d, seen_numbers_A[chromosomeA[i]] = %d\n", chromosomeA[i], seen_numbers_A[chromosomeA[i]]);
-		seen_numbers_B[chromosomeB[i]]++; // Takes tail from A
-		//printf("chromosomeB[i] = %d, seen_numbers_B[chromosomeB[i]] = %d\n", chromosomeB[i], seen_numbers_B[chromosomeB[i]]);
+	_mm512_storeu_si512(bins, bins_v);
+	_mm512_storeu_si512(weight, weight_v);
+	_mm512_storeu_si512(remaining, remaining_v);
+}
+#endif
+
+// Batched next-fit kernel, the widest one the CPU supports unless chosen on the command line
+lanes_kernel_t next_fit_lanes = next_fit_lanes_scalar;
+
+// Picks the batched next-fit kernel for a requested instruction set ("auto", "avx512", "avx2" or
+// "scalar"), falling back to narrower ones the CPU lacks. Returns the name of the one picked,
+// or NULL for an unknown request.
+char *select_simd(char *request) {
+	if (strcmp(request, "auto") != 0 && strcmp(request, "avx512") != 0 && strcmp(request, "avx2") != 0
+			&& strcmp(request, "scalar") != 0) {
+		return NULL;
+	}
+	int want_avx512 = strcmp(request, "auto") == 0 || strcmp(request, "avx512") == 0;
+	int want_avx2 = want_avx512 || strcmp(request, "avx2") == 0;
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (want_avx512 && __builtin_cpu_supports("avx512f")) {
+		next_fit_lanes = next_fit_lanes_avx512;
+		return "avx512";
 	}
+	if (want_avx2 && __builtin_cpu_supports("avx2")) {
+		next_fit_lanes = next_fit_lanes_avx2;
+		return "avx2";
+	}
+#endif
+	next_fit_lanes = next_fit_lanes_scalar;
+	return "scalar";
+}
 
-	// Count all the number of appearances in Chromosome's head of array
-	for (int i = 0; i < index; i++) {
-		head_numbers_A[chromosomeA[i]]++;
-		head_numbers_B[chromosomeB[i]]++;
+// Decoder used to turn a chromosome into a packing, selected on the command line
+decoder_t decoder = next_fit;
+
+// Determines fitness (number of bins) of an arrangement using the selected decoder
+int fitness(scratch_t *scratch, instance_t *instance, int *genes) {
+	return decoder(scratch, instance, genes);
+}
+
+// Caches the fitness of a new or changed chromosome by re-packing the whole chromosome with a
+// decoder that keeps no checkpoints (next-fit chromosomes go through evaluate_group instead)
+void evaluate(scratch_t *scratch, instance_t *instance, chromosome_t *chromosome) {
+	chromosome->fitness = fitness(scratch, instance, chromosome->genes);
+	chromosome->dirty = instance->size;
+}
+
+// Caches the fitness of a group of new or changed chromosomes. Next-fit can't vectorize along one
+// chromosome, so instead up to LANES chromosomes are packed side by side: every lane resumes from
+// its own checkpoint, and block by block their next CHECKPOINT_INTERVAL gene weights are staged
+// interleaved by lane for the batched kernel. Checkpoints are aligned, so all lanes reach their
+// next checkpoint on the same step. Other decoders evaluate one chromosome at a time. Callers
+// split larger groups into chunks, since count must not exceed LANES.
+void evaluate_group(scratch_t *scratch, instance_t *instance, chromosome_t *group, int count) {
+	if (count > LANES) {
+		fprintf(stderr, "Error: cannot evaluate %d chromosomes in one group of %d lanes.\n", count, LANES);
+		exit(EXIT_FAILURE);
+	}
+	if (decoder != next_fit) {
+		for (int lane = 0; lane < count; lane++) {
+			evaluate(scratch, instance, &group[lane]);
+		}
+		return;
 	}
 
-	// Decrement count of numbers from ChromosomeA's head of array from entirety of B's array
-	for (int i = 0; i < size; i++) {
-		// subtract head numbers from seen to get available numbers for tail
-		//printf("chromosomeB[i] = %d seen_numbers_A[chromosomeB[i]] = %d - head_numbers_B[chromosomeB[i]] %d = %d\n", chromosomeB[i], seen_numbers_A[chromosomeB[i]], head_numbers_B[chromosomeB[i]], seen_numbers_A[chromosomeB[i]] - head_numbers_B[chromosomeB[i]]);
-		if (head_numbers_B[chromosomeB[i]] > 0) {
-			seen_numbers_A[chromosomeB[i]]--; // takes tail from B
-			head_numbers_B[chromosomeB[i]]--;
+	int *weights = instance->weights;
+	int *staged = scratch->staged;
+	int size = instance->size;
+	int start[LANES], bins[LANES], weight[LANES], remaining[LANES];
+	int steps = 0;
+
+	// Resume every lane from the checkpoint before its first changed gene, unused lanes stay idle
+	for (int lane = 0; lane < LANES; lane++) {
+		start[lane] = size;
+		bins[lane] = 1;
+		weight[lane] = 0;
+		if (lane < count) {
+			start[lane] = group[lane].dirty / CHECKPOINT_INTERVAL * CHECKPOINT_INTERVAL;
+			if (start[lane] > 0) {
+				bins[lane] = group[lane].checkpoints[2 * (start[lane] / CHECKPOINT_INTERVAL)];
+				weight[lane] = group[lane].checkpoints[2 * (start[lane] / CHECKPOINT_INTERVAL) + 1];
+			}
 		}
-		if (head_numbers_A[chromosomeA[i]] > 0) {
-			seen_numbers_B[chromosomeA[i]]--; // takes tail from B
-			head_numbers_A[chromosomeA[i]]--;
+		remaining[lane] = size - start[lane];
+		if (remaining[lane] > steps) {
+			steps = remaining[lane];
 		}
 	}
 
-	// Append to tail of new offspring the remaining available numbers
-	int j = index;
-	int k = index;
+	for (int block = 0; block < steps; block += CHECKPOINT_INTERVAL) {
+		int block_steps = steps - block < CHECKPOINT_INTERVAL ? steps - block : CHECKPOINT_INTERVAL;
 
-	// Increment through the entire chromosome
-	for (int i = 0; i < size; i++) {
-
-		// Checks if that number is still available for addition into offspring tail
-		// Takes tail from B, Head from A
-		if (seen_numbers_B[chromosomeB[i]] > 0) {
-			offspring[0][j++] = chromosomeB[i];
-			seen_numbers_B[chromosomeB[i]]--;
+		// Record each lane's checkpoint and stage its next weights, padding with zeros past its end
+		for (int lane = 0; lane < LANES; lane++) {
+			int position = start[lane] + block;
+			int *genes = lane < count ? group[lane].genes : NULL;
+			if (position < size) {
+				group[lane].checkpoints[2 * (position / CHECKPOINT_INTERVAL)] = bins[lane];
+				group[lane].checkpoints[2 * (position / CHECKPOINT_INTERVAL) + 1] = weight[lane];
+			}
+			for (int step = 0; step < block_steps; step++, position++) {
+				staged[step * LANES + lane] = position < size ? weights[genes[position]] : 0;
+			}
 		}
+
+		next_fit_lanes(staged, block_steps, instance->max_weight, bins, weight, remaining);
 	}
 
+	for (int lane = 0; lane < count; lane++) {
+		group[lane].fitness = bins[lane];
+		group[lane].dirty = size;
+	}
+}
+
+// Employs the modern Fisher-Yates shuffle algorithm to shuffle an 
+// array of integers in-place with all permutations equally likely.
+void shuffle(rng_t *rng, int *array, int size) {
+	// Select random index [0, size-1] to swap with i
+	for (int i = size-1; i > 0; i--) {
+		swap(array, i, random_num(rng, i)); // swap i and j elements of the array in-place
+	}
+}
+
+// Takes the head of one parent up to index and fills the tail with the remaining items in
+// the order they appear in the other parent. counts must be all zero and is left all zero.
+void crossover_child(int *counts, int *head, int *tail, int *child, int index, int size) {
+	// Set head of array
+	for (int i = 0; i < index; i++) {
+		child[i] = head[i];
+	}
+
+	// Count the appearances of every item, less those already placed in the head
 	for (int i = 0; i < size; i++) {
+		counts[tail[i]]++;
+	}
+	for (int i = 0; i < index; i++) {
+		counts[head[i]]--;
+	}
 
-		// Takes tail from A, Head from B
-		if (seen_numbers_A[chromosomeA[i]] > 0) {
-			offspring[1][k++] = chromosomeA[i];
-			seen_numbers_A[chromosomeA[i]]--;
+	// Append to tail of new offspring the remaining available items, which brings
+	// every count touched here back to zero
+	int j = index;
+	for (int i = 0; i < size; i++) {
+		if (counts[tail[i]] > 0) {
+			child[j++] = tail[i];
+			counts[tail[i]]--;
 		}
 	}
+}
 
-	//printf("Crossover index ends=%d (noninclusive)\n", index);
-	return offspring;
+// Writes the two offspring of chromosomeA and chromosomeB directly into offspringA and offspringB
+void crossover(rng_t *rng, scratch_t *scratch, chromosome_t *chromosomeA, chromosome_t *chromosomeB,
+		chromosome_t *offspringA, chromosome_t *offspringB, int size) {
+	// Generate random crossover point
+	int index = 1 + random_num(rng, size-1 - 1);
+
+	crossover_child(scratch->counts, chromosomeA->genes, chromosomeB->genes, offspringA->genes, index, size); // Head from A - takes tail from B
+	crossover_child(scratch->counts, chromosomeB->genes, chromosomeA->genes, offspringB->genes, index, size); // Head from B - takes tail from A
+
+	// Checkpoints inside the head only depend on the head, so they carry over from the parent
+	// (only next-fit records checkpoints, the other decoders re-pack whole chromosomes)
+	if (decoder == next_fit) {
+		int head_checkpoints = 2 * (index / CHECKPOINT_INTERVAL + 1);
+		copyInto2DArray(offspringA->checkpoints, chromosomeA->checkpoints, head_checkpoints);
+		copyInto2DArray(offspringB->checkpoints, chromosomeB->checkpoints, head_checkpoints);
+		offspringA->dirty = index;
+		offspringB->dirty = index;
+	}
 }
 
-int *most_fit(int **population, int size, int max_weight, int max_search) {
+int *most_fit(chromosome_t *population, int max_search) {
 	int *best_indexes = malloc(max_search * sizeof(int));
 	int first_best = INT_MAX;
 	int first_done = 0;
@@ -186,7 +637,7 @@ int *most_fit(int **population, int size, int max_weight, int max_search) {
 	for (int top = 0; top < max_search; top++) {
 		int best_bin = -1;
 		for (int chromosome = 0; chromosome < POP_SIZE; chromosome++) {
-			best_bin = fitness(population[chromosome], size, max_weight);
+			best_bin = population[chromosome].fitness;
 			if (first_done == 0 && best_bin < first_best) {
 				first_best = best_bin;
 				first_index = chromosome;
@@ -204,11 +655,11 @@ int *most_fit(int **population, int size, int max_weight, int max_search) {
 	return best_indexes;
 }
 
-int least_fit(int **population, int size, int max_weight) {
+int least_fit(chromosome_t *population) {
 	int worst_index = -1;
 	int worst_fitness = -1;
 	for (int chromosome = 0; chromosome < POP_SIZE; chromosome++) {
-		int worst_bin = fitness(population[chromosome], size, max_weight);
+		int worst_bin = population[chromosome].fitness;
 		if (worst_bin > worst_fitness) {
 			worst_fitness = worst_bin;
 			worst_index = chromosome;
@@ -218,19 +669,74 @@ int least_fit(int **population, int size, int max_weight) {
 	return worst_index;
 }
 
-// Compares fitness of all chromosomes in a population (for qsort).
+// Compares cached fitness of all chromosomes in a population (for qsort). Ties go to the
+// newer chromosome and then to the earlier arena row, so no two chromosomes compare equal.
 int compare_fitness(const void *p, const void *q) {
-	int **l = (int **) p;
-	int **r = (int **) q; 
-	int left = fitness(*l, size, max_weight);
-	int right = fitness(*r, size, max_weight);
-	if (left > right) {
-		return 1;
-	}
-	if (left < right) {
-		return -1;
+	chromosome_t *l = (chromosome_t *) p;
+	chromosome_t *r = (chromosome_t *) q;
+	if (l->fitness != r->fitness) {
+		return l->fitness > r->fitness ? 1 : -1;
 	}
-	return 0;
+	if (l->birth != r->birth) {
+		return l->birth < r->birth ? 1 : -1;
+	}
+	return (l->genes > r->genes) - (l->genes < r->genes);
+}
+
+// Swap two chromosomes of a population, moving only their pointers and cached values
+void swap_chromosomes(chromosome_t *population, int a, int b) {
+	chromosome_t temp = population[a];
+	population[a] = population[b];
+	population[b] = temp;
+}
+
+// Rearranges a population so its first survivors chromosomes are the most fit ones, with the
+// single most fit (the elite) at the front and the rest in no particular order. Uses quickselect
+// with a median-of-three pivot, linear time on average rather than sorting the whole population.
+void select_survivors(chromosome_t *population, int count, int survivors) {
+	int low = 0;
+	int high = count - 1;
+
+	while (survivors < count && low < high) {
+		// Move the median of the first, middle and last chromosomes to the end as the pivot
+		int mid = low + (high - low) / 2;
+		if (compare_fitness(&population[mid], &population[low]) < 0) {
+			swap_chromosomes(population, mid, low);
+		}
+		if (compare_fitness(&population[high], &population[low]) < 0) {
+			swap_chromosomes(population, high, low);
+		}
+		if (compare_fitness(&population[mid], &population[high]) < 0) {
+			swap_chromosomes(population, mid, high);
+		}
+
+		// Partition around the pivot
+		int store = low;
+		for (int i = low; i < high; i++) {
+			if (compare_fitness(&population[i], &population[high]) < 0) {
+				swap_chromosomes(population, i, store++);
+			}
+		}
+		swap_chromosomes(population, store, high);
+
+		// Continue only in the side holding the boundary between survivors and the culled
+		if (store == survivors) {
+			break;
+		} else if (store < survivors) {
+			low = store + 1;
+		} else {
+			high = store - 1;
+		}
+	}
+
+	// Elitism - the most fit survivor always sits at the front
+	int elite = 0;
+	for (int i = 1; i < survivors && i < count; i++) {
+		if (compare_fitness(&population[i], &population[elite]) < 0) {
+			elite = i;
+		}
+	}
+	swap_chromosomes(population, 0, elite);
 }
 
 // Determines if a value already exists in an array
@@ -244,12 +750,12 @@ int value_in_array(int value, int *array, int size) {
 }
 
 // Want to make sure you don't choose the same individual twice
-int tournament_selection(int **population, int size, int participants, int max_weight) {
+int tournament_selection(rng_t *rng, chromosome_t *population, int participants) {
 	int indexes[participants]; // Random population indexes for tournament selection
 
 	// Initialize indexes with random values not checking for duplicates
 	for (int i = 0; i < participants; i++) {
-		indexes[i] = random_num(POP_SIZE-1);
+		indexes[i] = random_num(rng, POP_SIZE-1);
 	}
 	
 	// Runs through random values, regenerating duplicate indexes values with new values not in array
@@ -258,7 +764,7 @@ int tournament_selection(int **population, int size, int participants, int max_w
 
 		// If the value already exists in the indexes array, generate a new random index
 		while (value_in_array(index, indexes, participants) == 1) {
-			index = random_num(POP_SIZE-1);
+			index = random_num(rng, POP_SIZE-1);
 		}
 	
 		indexes[i] = index;
@@ -268,7 +774,7 @@ int tournament_selection(int **population, int size, int participants, int max_w
 	int best_fitness = INT_MAX;
 	int winner_index = 0;
 	for (int i = 0; i < participants; i++) {
-		int index_fitness = fitness(population[indexes[i]], size, max_weight);
+		int index_fitness = population[indexes[i]].fitness;
 		if (index_fitness < best_fitness) {
 			best_fitness = index_fitness;
 			winner_index = indexes[i];
@@ -279,124 +785,360 @@ int tournament_selection(int **population, int size, int participants, int max_w
 }
 
 
-// Returns two array elements (genes) unique to eachother index-wise
+// Stores two array elements (genes) unique to eachother index-wise into genes
 // Possibility that the actual values be the same
 // TODO: Might need to also return new random gene if values are the same
-int *get_unique_genes(int size) {
-	int *genes = malloc(2 * sizeof(int));
-	genes[0] = random_num(size-1);
+void get_unique_genes(rng_t *rng, int *genes, int size) {
+	genes[0] = random_num(rng, size-1);
 
 	do {
-		genes[1] = random_num(size-1);
+		genes[1] = random_num(rng, size-1);
 	} while (genes[0] == genes[1]);
-
-	return genes;
 }
 
 // Mutates a chromosome in-place, swapping two random indexes
-void swap_mutate(int *chromosome, int size) {
-	int *genes = get_unique_genes(size);
-	swap(chromosome, genes[0], genes[1]);
+void swap_mutate(rng_t *rng, chromosome_t *chromosome, int size) {
+	int genes[2];
+	get_unique_genes(rng, genes, size);
+	swap(chromosome->genes, genes[0], genes[1]);
+
+	// Everything before the first swapped gene is unchanged
+	int first = genes[0] < genes[1] ? genes[0] : genes[1];
+	if (first < chromosome->dirty) {
+		chromosome->dirty = first;
+	}
 }
 
 
 // Decides which mutation mechanism to use
-void mutate(int *chromosome, int size) {
-	swap_mutate(chromosome, size);
+void mutate(rng_t *rng, chromosome_t *chromosome, int size) {
+	swap_mutate(rng, chromosome, size);
 }
 
-int main(int argc, char** argv) {
-	unsigned long seed = clock() * time(NULL) * getpid();
-	// Seed only once at the top of the program
-	// If you reseed too quickly during the same second, you will end up getting the same numbers
-	srand(seed);
-	srandom(seed);
-	char *file_name = argv[1];
-
-	max_weight = -1; // Max bin weight
-	size = -1; // Number of items to organize
-	
+// Compares two ints in ascending order (for qsort).
+int compare_int(const void *p, const void *q) {
+	int left = *(const int *) p;
+	int right = *(const int *) q;
+	return (left > right) - (left < right);
+}
+
+// Returns the number of item IDs whose weight is at most value (weights are in ascending order)
+int weights_at_most(instance_t *instance, long long value) {
+	int low = 0;
+	int high = instance->types;
+	while (low < high) {
+		int mid = low + (high - low) / 2;
+		if (instance->weights[mid] <= value) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+// Computes the lower bounds on the number of bins of an instance. L1 is the total weight over the
+// capacity. Martello and Toth's L2 also accounts for large items that can never share a bin: for
+// every alpha up to half the capacity, items heavier than C - alpha (J1) and C/2 (J2) each need
+// their own bin, and items of at least alpha (J3) only fit into the room J2 leaves over.
+void lower_bounds(instance_t *instance) {
+	int types = instance->types;
+	long long capacity = instance->max_weight;
+
+	// Prefix counts and total weights over item IDs
+	long long *count = calloc(types + 1, sizeof(long long));
+	long long *sum = calloc(types + 1, sizeof(long long));
+	for (int i = 0; i < instance->size; i++) {
+		count[instance->items[i] + 1]++;
+	}
+	for (int t = 0; t < types; t++) {
+		sum[t + 1] = sum[t] + count[t + 1] * instance->weights[t];
+		count[t + 1] += count[t];
+	}
+
+	instance->l1 = (sum[types] + capacity - 1) / capacity;
+
+	// alpha = 0 and every distinct weight up to half the capacity are the only values worth trying
+	int half = weights_at_most(instance, capacity / 2);
+	instance->l2 = 0;
+	for (int a = -1; a < half; a++) {
+		long long alpha = a < 0 ? 0 : instance->weights[a];
+		int j1 = weights_at_most(instance, capacity - alpha); // J1 starts here
+		int j2 = half; // J2 starts here
+		int j3 = a < 0 ? 0 : a; // J3 starts here
+
+		long long large = (count[types] - count[j1]) + (count[j1] - count[j2]);
+		long long room = (count[j1] - count[j2]) * capacity - (sum[j1] - sum[j2]);
+		long long excess = (sum[j2] - sum[j3]) - room;
+		long long bound = large + (excess > 0 ? (excess + capacity - 1) / capacity : 0);
+		if (bound > instance->l2) {
+			instance->l2 = bound;
+		}
+	}
+
+	instance->lower_bound = instance->l1 > instance->l2 ? instance->l1 : instance->l2;
+	free(count);
+	free(sum);
+}
+
+// Reads the header of an instance file (bin capacity and number of items), returning 0 on success
+int read_header(FILE *fp, char *file_name, int *max_weight, int *size) {
+	if (fscanf(fp, "%d %d", max_weight, size) != 2 || *max_weight < 1 || *size < 2) {
+		fprintf(stderr, "Error: %s is not a valid instance.\n", file_name);
+		return -1;
+	}
+	return 0;
+}
 
-	// File handling
+// Reads an instance file (bin capacity, number of items, then every item weight) and remaps
+// the items to dense IDs, so per-item bookkeeping is sized by the instance, not by its weights.
+// Returns 0 on success.
+int load_instance(instance_t *instance, char *file_name) {
 	FILE *fp;
 	if ((fp = fopen(file_name, "r")) == NULL) {
-		printf("File not found.");
-		exit(EXIT_FAILURE);
+		fprintf(stderr, "Error: %s does not exist in directory.\n", file_name);
+		return -1;
 	}
 
-	fscanf(fp, "%d", &max_weight); // Get the max bin weight from file
-	fscanf(fp, "%d", &size); // Get the number of items to organize from file
-	
-	int items[size]; // All item weights to be organized
-	
-	// Gets all items from the file and stores into array
+	// Get the max bin weight and the number of items to organize from file
+	if (read_header(fp, file_name, &instance->max_weight, &instance->size) != 0) {
+		fclose(fp);
+		return -1;
+	}
+	int size = instance->size;
+
+	// Gets all item weights from the file, held on the heap since instances can be large
+	int *items = malloc(size * sizeof(int));
+	int *weights = malloc(size * sizeof(int));
 	for (int i = 0; i < size; i++) {
-		fscanf(fp, "%d", &items[i]);
+		if (fscanf(fp, "%d", &items[i]) != 1 || items[i] < 0) {
+			fprintf(stderr, "Error: %s is missing item weights.\n", file_name);
+			fclose(fp);
+			free(items);
+			free(weights);
+			return -1;
+		}
+		// An item that fits in no bin makes the instance infeasible and the lower bounds meaningless
+		if (items[i] > instance->max_weight) {
+			fprintf(stderr, "Error: %s has an item of weight %d, heavier than a bin (%d).\n", file_name, items[i], instance->max_weight);
+			fclose(fp);
+			free(items);
+			free(weights);
+			return -1;
+		}
+		weights[i] = items[i];
 	}
+	fclose(fp);
 
-	// Allocating 2D array to hold multiple chromosomes
-	int **population = malloc(POP_SIZE * sizeof(int *));
-	for (int i = 0; i < POP_SIZE; i++) {
-		population[i] = malloc(size * sizeof(int));
+	// Distinct weights in ascending order become the item IDs
+	qsort(weights, size, sizeof(int), compare_int);
+	int types = 0;
+	for (int i = 0; i < size; i++) {
+		if (types == 0 || weights[types - 1] != weights[i]) {
+			weights[types++] = weights[i];
+		}
+	}
+
+	// Replace every item weight by its ID
+	for (int i = 0; i < size; i++) {
+		int *id = bsearch(&items[i], weights, types, sizeof(int), compare_int);
+		items[i] = id - weights;
+	}
+
+	instance->types = types;
+	instance->weights = realloc(weights, types * sizeof(int));
+	instance->items = items;
+
+	lower_bounds(instance);
+	return 0;
+}
+
+// Frees an instance
+void free_instance(instance_t *instance) {
+	free(instance->weights);
+	free(instance->items);
+}
+
+// Finds the islands this rank sends its migrants to and receives migrants from.
+// A ring always passes migrants to the next rank, while the random topology draws a fresh
+// random ring for every migration from a stream that is identical on all ranks.
+void migration_partners(rng_t *migration_rng, int topology, int rank, int ranks, int *order, int *dest, int *source) {
+	for (int i = 0; i < ranks; i++) {
+		order[i] = i;
+	}
+	if (topology == TOPOLOGY_RANDOM) {
+		shuffle(migration_rng, order, ranks);
+	}
+
+	// Find this rank's position in the ring and its neighbours on either side
+	for (int i = 0; i < ranks; i++) {
+		if (order[i] == rank) {
+			*dest = order[(i + 1) % ranks];
+			*source = order[(i - 1 + ranks) % ranks];
+		}
+	}
+}
+
+// Evolves a population for one instance until it reaches the lower bound, stops improving or runs
+// out of its generation or time budget. With several ranks every rank is an island of the same run.
+void solve(instance_t *instance, options_t *options, int rank, int ranks, result_t *result) {
+	double start_time = omp_get_wtime();
+	int threads = options->threads;
+	int migrants = options->migrants;
+	int size = instance->size;
+	long long evaluations = 0;
+
+	// One random number stream per thread on every island, all derived from the same seed
+	rng_t *rngs = aligned_alloc(64, threads * sizeof(rng_t));
+	for (int t = 0; t < threads; t++) {
+		rng_seed(&rngs[t], options->seed, rank * threads + t);
+	}
+
+	// Stream shared by all islands to agree on the random migration topology
+	rng_t migration_rng;
+	rng_seed(&migration_rng, options->seed, ranks * threads);
+
+	// Crossover and decoder working memory for every thread
+	scratch_t *scratches = aligned_alloc(64, threads * sizeof(scratch_t));
+	for (int t = 0; t < threads; t++) {
+		scratch_init(&scratches[t], instance);
 	}
 
-	int **total_population = malloc((2 * POP_SIZE) * sizeof(int *));
+	// Batched next-fit evaluates LANES chromosomes per parallel iteration, the other decoders
+	// gain nothing from grouping and are spread over the threads one chromosome at a time
+	int group = decoder == next_fit ? LANES : 1;
+
+	// Benchmark runs time every phase and record the best of every generation
+	int profile = options->benchmark;
+	double survivors_time = 0;
+	result->curve = profile ? malloc((options->generations + 1) * sizeof(int)) : NULL;
+
+	// Allocating a single flat arena holding the genes and then the checkpoints of every chromosome back to back
+	int checkpoints = 2 * ((size - 1) / CHECKPOINT_INTERVAL + 1);
+	int *arena = malloc((size_t) (2 * POP_SIZE) * (size + checkpoints) * sizeof(int));
+
+	// Each chromosome points at its own rows of the arena
+	chromosome_t *total_population = malloc((2 * POP_SIZE) * sizeof(chromosome_t));
 	for (int i = 0; i < (2 * POP_SIZE); i++) {
-		total_population[i] = malloc(size * sizeof(int));
+		total_population[i].genes = arena + (size_t) i * size;
+		total_population[i].checkpoints = arena + (size_t) (2 * POP_SIZE) * size + (size_t) i * checkpoints;
 	}
+
+	// Survivors always occupy the first POP_SIZE slots, offspring are written into the
+	// remaining slots (whose rows belong to last generation's culled chromosomes)
+	chromosome_t *population = total_population;
+	chromosome_t *offspring = total_population + POP_SIZE;
+
+	// Buffers for the genes of outgoing and incoming migrants
+	int *send_buffer = malloc((size_t) migrants * size * sizeof(int));
+	int *recv_buffer = malloc((size_t) migrants * size * sizeof(int));
+	int *order = malloc(ranks * sizeof(int));
+	MPI_Request requests[2];
 		
 	// Generate first random population
+	#pragma omp parallel for num_threads(threads) schedule(static)
 	for (int i = 0; i < POP_SIZE; i++) {
-		// Shuffle original item order in-place and copy into population array multiple times
-		shuffle(items, size);
-		copyInto2DArray(population[i], items, size);
+		// Copy original item order into the population array and shuffle it in-place
+		copyInto2DArray(population[i].genes, instance->items, size);
+		shuffle(&rngs[omp_get_thread_num()], population[i].genes, size);
+		population[i].dirty = 0;
+		population[i].birth = 0;
 	}
+	#pragma omp parallel for num_threads(threads) schedule(static)
+	for (int i = 0; i < POP_SIZE; i += group) {
+		evaluate_group(&scratches[omp_get_thread_num()], instance, &population[i], POP_SIZE - i < group ? POP_SIZE - i : group);
+	}
+	evaluations += POP_SIZE;
 	
-	int best = INT_MAX;
+	// Bring the most fit of the initial population to the front
+	select_survivors(population, POP_SIZE, POP_SIZE);
+
+	// Best over all islands, and whether any island ran out of time (as a negative so a
+	// single MIN reduction carries both), so every island agrees on when to stop
+	int status[2] = { population[0].fitness, 0 };
+	if (ranks > 1) {
+		MPI_Allreduce(MPI_IN_PLACE, status, 2, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+	}
+	int best = status[0];
+	int expired = 0;
+	if (profile) {
+		result->curve[0] = best;
+	}
 
 	// Convergence variables
 	int no_improvement = 0;
-	int previous_fitness = INT_MAX;
+	int previous_fitness = best;
 
-	// Generational loop
-	for (int gen = 0; gen < END_GEN && no_improvement <= NO_IMPROVEMENT; gen++) {
+	// Generational loop, ending early once the best matches the lower bound (it cannot improve)
+	// or, in anytime mode, once the time limit is up. Benchmark runs always use the whole budget.
+	int gen;
+	for (gen = 0; gen < options->generations && !expired
+			&& (profile || (no_improvement <= NO_IMPROVEMENT && best > instance->lower_bound)); gen++) {
 		
+		// Migration - every few generations the top chromosomes of each island travel to another island.
+		// Messages are non-blocking so they are in flight while this generation's offspring are made.
+		int migrating = ranks > 1 && migrants > 0 && gen > 0 && gen % options->migration_interval == 0;
+		if (migrating) {
+			int dest, source;
+			migration_partners(&migration_rng, options->topology, rank, ranks, order, &dest, &source);
+
+			// Bring the island's most fit chromosomes to the head of the population
+			select_survivors(population, POP_SIZE, migrants);
+			for (int m = 0; m < migrants; m++) {
+				copyInto2DArray(send_buffer + (size_t) m * size, population[m].genes, size);
+			}
+			MPI_Irecv(recv_buffer, migrants * size, MPI_INT, source, MIGRATION_TAG, MPI_COMM_WORLD, &requests[0]);
+			MPI_Isend(send_buffer, migrants * size, MPI_INT, dest, MIGRATION_TAG, MPI_COMM_WORLD, &requests[1]);
+		}
+
 		// Selection - Choice which chromosomes move on to the next generation
 		// Can currently select the same chromosome twice
-		for (int i = 0; i < POP_SIZE; i++) {
-			copyInto2DArray(total_population[i], population[i], size);
-		}
-		
-		// Generate offspring the size of POP_SIZE
-		for (int i = 1; i <= POP_SIZE; i+=2) {
+		// Generate offspring the size of POP_SIZE, one pair per iteration spread over the threads.
+		// Static scheduling keeps the pair-to-thread mapping (and so every stream) reproducible.
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for (int i = 0; i < POP_SIZE; i+=2) {
+			rng_t *rng = &rngs[omp_get_thread_num()];
+			scratch_t *scratch = &scratches[omp_get_thread_num()];
+			double mark = profile ? omp_get_wtime() : 0;
 
 			// Getting two unique parents that have been selected from a random group
-			int chromosomeA = tournament_selection(population, size, TOURNAMENT_SIZE, max_weight);
-			int chromosomeB = tournament_selection(population, size, TOURNAMENT_SIZE, max_weight);
+			int chromosomeA = tournament_selection(rng, population, TOURNAMENT_SIZE);
+			int chromosomeB = tournament_selection(rng, population, TOURNAMENT_SIZE);
 
 			while (chromosomeA == chromosomeB) {
-				chromosomeB = tournament_selection(population, size, TOURNAMENT_SIZE, max_weight);
+				chromosomeB = tournament_selection(rng, population, TOURNAMENT_SIZE);
+			}
+			if (profile) {
+				lap(scratch, PHASE_SELECTION, &mark);
 			}
 
-			// Generate offspring from parents who won the selection process
-			int **offspring = crossover(population[chromosomeA], population[chromosomeB], size);
+			// Generate offspring from parents who won the selection process straight into their slots
+			chromosome_t *child_A = &offspring[i];
+			chromosome_t *child_B = &offspring[i + 1];
+			crossover(rng, scratch, &population[chromosomeA], &population[chromosomeB], child_A, child_B, size);
+			if (profile) {
+				lap(scratch, PHASE_CROSSOVER, &mark);
+			}
 
 
 			// Offspring generated from crossover has a chance to mutate
-			double mutate_A = rand() / (double) RAND_MAX;
-			double mutate_B = rand() / (double) RAND_MAX;
+			double mutate_A = random_double(rng);
+			double mutate_B = random_double(rng);
 
 			if (mutate_A <= MUTATION_PROB) {
-				mutate(offspring[0], size);
+				mutate(rng, child_A, size);
 			}
 			
 			if (mutate_B <= MUTATION_PROB) {
-				mutate(offspring[1], size);
+				mutate(rng, child_B, size);
+			}
+			if (profile) {
+				lap(scratch, PHASE_MUTATION, &mark);
 			}
 
-			// Offspring get added to the population for sorting
-			copyInto2DArray(total_population[POP_SIZE * 2 - i], offspring[0], size);
-			copyInto2DArray(total_population[POP_SIZE * 2 - (i + 1)], offspring[1], size);
+			// Offspring are already part of the population for sorting
+			child_A->birth = gen + 1;
+			child_B->birth = gen + 1;
 
 			// With new offspring, we need to cull some individuals from population
 
@@ -415,13 +1157,40 @@ int main(int argc, char** argv) {
 
 			//for (int i = 0; i < 2; i++) { printArray(offspring[i], size); }
 		}
+
+		// Evaluating fitness of the offspring only once here, a group at a time spread over the threads
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for (int i = 0; i < POP_SIZE; i += group) {
+			scratch_t *scratch = &scratches[omp_get_thread_num()];
+			double mark = profile ? omp_get_wtime() : 0;
+			evaluate_group(scratch, instance, &offspring[i], POP_SIZE - i < group ? POP_SIZE - i : group);
+			if (profile) {
+				lap(scratch, PHASE_EVALUATION, &mark);
+			}
+		}
+		evaluations += POP_SIZE;
 		
-		// Sort by most fit and use those
-		qsort(total_population, 2 * POP_SIZE, sizeof(total_population[0]), compare_fitness);
+		// Immigrants take over the last offspring slots and compete for survival like any other offspring
+		if (migrating) {
+			MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+			for (int m = 0; m < migrants; m++) {
+				chromosome_t *immigrant = &offspring[POP_SIZE - 1 - m];
+				copyInto2DArray(immigrant->genes, recv_buffer + (size_t) m * size, size);
+				immigrant->dirty = 0;
+				immigrant->birth = gen + 1;
+			}
+			for (int m = POP_SIZE - migrants; m < POP_SIZE; m += group) {
+				evaluate_group(&scratches[0], instance, &offspring[m], POP_SIZE - m < group ? POP_SIZE - m : group);
+			}
+			evaluations += migrants;
+		}
 
-		// After sort, keep the top POP_SIZE chromosomes
-		for (int i = 0; i < POP_SIZE; i++) {
-			copyInto2DArray(population[i], total_population[i], size);
+		// Cull to the POP_SIZE most fit by cached fitness, moving only the gene pointers rather than whole rows.
+		// The survivors are already the next generation's population, with the most fit first.
+		double mark = profile ? omp_get_wtime() : 0;
+		select_survivors(total_population, 2 * POP_SIZE, POP_SIZE);
+		if (profile) {
+			survivors_time += omp_get_wtime() - mark;
 		}
 
 		
@@ -444,8 +1213,16 @@ int main(int argc, char** argv) {
 		
 
 		//print2DArray(population, size);
-		if (fitness(population[0], size, max_weight) <= best) {
-			best = fitness(population[0], size, max_weight);
+		// Best over all islands, so every island agrees on convergence
+		status[0] = population[0].fitness;
+		status[1] = options->time_limit > 0 && omp_get_wtime() - start_time >= options->time_limit ? -1 : 0;
+		if (ranks > 1) {
+			MPI_Allreduce(MPI_IN_PLACE, status, 2, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+		}
+		best = status[0];
+		expired = status[1] < 0;
+		if (profile) {
+			result->curve[gen + 1] = best;
 		}
 		
 		// Convergence detection
@@ -457,7 +1234,495 @@ int main(int argc, char** argv) {
 		previous_fitness = best;
 	}
 	
-	printf("Most fit found: %d\n", fitness(population[0], size, max_weight));
+	result->reason = "generation limit";
+	if (best <= instance->lower_bound) {
+		result->reason = "lower bound reached";
+	} else if (expired) {
+		result->reason = "time limit";
+	} else if (no_improvement > NO_IMPROVEMENT) {
+		result->reason = "no improvement";
+	}
+	result->bins = best;
+	result->generations = gen;
+	result->evaluations = evaluations;
+	result->runtime = omp_get_wtime() - start_time;
+
+	// Phase times summed over the threads
+	for (int phase = 0; phase < PHASES; phase++) {
+		result->phase_time[phase] = 0;
+		for (int t = 0; t < threads; t++) {
+			result->phase_time[phase] += scratches[t].phase_time[phase];
+		}
+	}
+	result->phase_time[PHASE_SURVIVORS] += survivors_time;
+
+	free(total_population);
+	free(arena);
+	free(rngs);
+	for (int t = 0; t < threads; t++) {
+		scratch_free(&scratches[t]);
+	}
+	free(scratches);
+	free(send_buffer);
+	free(recv_buffer);
+	free(order);
+}
+
+// Contains one instance of a batch along with its result
+struct job {
+	char *file_name;
+	int index; // position in the manifest
+	int size; // number of items, read up front to schedule the largest instances first
+	int loaded; // whether the instance could be read
+	int lower_bound;
+	result_t result;
+};
+typedef struct job job_t;
+
+// Orders jobs from the most to the least items, then by manifest position (for qsort).
+int compare_jobs(const void *p, const void *q) {
+	job_t *l = *(job_t **) p;
+	job_t *r = *(job_t **) q;
+	if (l->size != r->size) {
+		return l->size < r->size ? 1 : -1;
+	}
+	return l->index - r->index;
+}
+
+// Writes text as a quoted JSON string, escaping quotes, backslashes and control characters
+void write_json_string(FILE *fp, char *text) {
+	fputc('"', fp);
+	for (unsigned char *c = (unsigned char *) text; *c != '\0'; c++) {
+		if (*c == '"' || *c == '\\') {
+			fprintf(fp, "\\%c", *c);
+		} else if (*c < 0x20) {
+			fprintf(fp, "\\u%04x", *c);
+		} else {
+			fputc(*c, fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+// Writes text as a CSV field, quoted with embedded quotes doubled when it holds a comma, quote or line break
+void write_csv_field(FILE *fp, char *text) {
+	if (strpbrk(text, ",\"\r\n") == NULL) {
+		fputs(text, fp);
+		return;
+	}
+	fputc('"', fp);
+	for (char *c = text; *c != '\0'; c++) {
+		if (*c == '"') {
+			fputc('"', fp);
+		}
+		fputc(*c, fp);
+	}
+	fputc('"', fp);
+}
+
+// Writes the results of a batch as JSON when the file name ends in .json, otherwise as CSV
+void write_results(char *output_name, job_t *jobs, int count) {
+	FILE *fp;
+	if ((fp = fopen(output_name, "w")) == NULL) {
+		fprintf(stderr, "ERROR in writing to results file %s\n", output_name);
+		exit(EXIT_FAILURE);
+	}
+
+	int json = strlen(output_name) >= 5 && strcmp(output_name + strlen(output_name) - 5, ".json") == 0;
+	if (json) {
+		fprintf(fp, "[\n");
+	} else {
+		fprintf(fp, "instance,items,bins,lower_bound,generations,evaluations,runtime_s,stopped\n");
+	}
+
+	for (int i = 0; i < count; i++) {
+		job_t *job = &jobs[i];
+		if (json) {
+			fprintf(fp, "  {\"instance\": ");
+			write_json_string(fp, job->file_name);
+			fprintf(fp, ", \"items\": %d, \"bins\": %d, \"lower_bound\": %d, \"generations\": %d, "
+					"\"evaluations\": %lld, \"runtime_s\": %.6f, \"stopped\": \"%s\"}%s\n",
+					job->size, job->result.bins, job->lower_bound, job->result.generations,
+					job->result.evaluations, job->result.runtime, job->result.reason, i + 1 < count ? "," : "");
+		} else {
+			write_csv_field(fp, job->file_name);
+			fprintf(fp, ",%d,%d,%d,%d,%lld,%.6f,%s\n", job->size, job->result.bins, job->lower_bound,
+					job->result.generations, job->result.evaluations, job->result.runtime, job->result.reason);
+		}
+	}
+
+	if (json) {
+		fprintf(fp, "]\n");
+	}
+	fclose(fp);
+}
+
+// Solves every instance listed in a manifest (one file per line, # starts a comment) on a pool of
+// worker threads, one instance per worker at a time. The instances with the most items are handed
+// out first so the slowest ones do not start last and hold up the end of the batch.
+void solve_batch(char *manifest_name, char *output_name, options_t *options) {
+	FILE *fp;
+	if ((fp = fopen(manifest_name, "r")) == NULL) {
+		fprintf(stderr, "Error: %s does not exist in directory.\n", manifest_name);
+		exit(EXIT_FAILURE);
+	}
+
+	// Read the instance file names
+	int count = 0;
+	int capacity = 64;
+	job_t *jobs = malloc(capacity * sizeof(job_t));
+	char line[4096];
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0] == '\0' || line[0] == '#') {
+			continue;
+		}
+		if (count == capacity) {
+			capacity *= 2;
+			jobs = realloc(jobs, capacity * sizeof(job_t));
+		}
+		memset(&jobs[count], 0, sizeof(job_t));
+		jobs[count].file_name = strdup(line);
+		jobs[count].index = count;
+		count++;
+	}
+	fclose(fp);
+
+	// Peek at every header for the number of items, the estimate of how long an instance takes
+	job_t **schedule = malloc(count * sizeof(job_t *));
+	for (int i = 0; i < count; i++) {
+		int max_weight;
+		FILE *instance_fp = fopen(jobs[i].file_name, "r");
+		if (instance_fp != NULL) {
+			if (read_header(instance_fp, jobs[i].file_name, &max_weight, &jobs[i].size) != 0) {
+				jobs[i].size = 0;
+			}
+			fclose(instance_fp);
+		}
+		schedule[i] = &jobs[i];
+	}
+	qsort(schedule, count, sizeof(job_t *), compare_jobs);
+
+	// Each worker evolves its instance on its own, so one thread per population
+	options_t job_options = *options;
+	job_options.threads = 1;
+	double start_time = omp_get_wtime();
+
+	#pragma omp parallel for num_threads(options->threads) schedule(dynamic, 1)
+	for (int i = 0; i < count; i++) {
+		job_t *job = schedule[i];
+		instance_t instance;
+		if (load_instance(&instance, job->file_name) != 0) {
+			job->result.bins = -1;
+			job->result.reason = "invalid instance";
+			continue;
+		}
+		job->loaded = 1;
+		job->lower_bound = instance.lower_bound;
+		solve(&instance, &job_options, 0, 1, &job->result);
+		free(job->result.curve);
+		free_instance(&instance);
+	}
+
+	write_results(output_name, jobs, count);
+
+	int solved = 0;
+	int optimal = 0;
+	for (int i = 0; i < count; i++) {
+		solved += jobs[i].loaded;
+		optimal += jobs[i].loaded && jobs[i].result.bins <= jobs[i].lower_bound;
+	}
+	printf("Solved %d of %d instances in %.3f s, %d at their lower bound. Results stored in: %s\n",
+			solved, count, omp_get_wtime() - start_time, optimal, output_name);
+
+	for (int i = 0; i < count; i++) {
+		free(jobs[i].file_name);
+	}
+	free(jobs);
+	free(schedule);
+}
+
+// Writes a random instance in the same format as the instance files. Classes:
+//   uniform    - capacity 1000, weights uniform in [1, 1000]
+//   falkenauer - Falkenauer's uniform class, capacity 150, weights uniform in [20, 100]
+//   triplet    - Falkenauer's triplet class, capacity 1000, items in triplets that exactly fill a bin
+//                (so the optimum is items / 3), every weight in [250, 500]
+// Without an output name the file is named after the class and number of items. Returns 0 on success.
+int generate_instance(char *class_name, int items, uint64_t seed, char *output_name) {
+	rng_t rng;
+	rng_seed(&rng, seed, 0);
+	int capacity;
+	int *weights;
+
+	// Instance files need at least two items, and a triplet instance at least one whole triplet
+	int minimum = strcmp(class_name, "triplet") == 0 ? 3 : 2;
+	if (items < minimum) {
+		fprintf(stderr, "Error: a %s instance needs at least %d items, got %d.\n", class_name, minimum, items);
+		return -1;
+	}
+
+	if (strcmp(class_name, "triplet") == 0) {
+		capacity = 1000;
+		items = (items + 2) / 3 * 3;
+		weights = malloc(items * sizeof(int));
+		for (int i = 0; i < items; i += 3) {
+			weights[i] = 380 + random_num(&rng, 490 - 380);
+			weights[i + 1] = 250 + random_num(&rng, (capacity - weights[i]) / 2 - 250);
+			weights[i + 2] = capacity - weights[i] - weights[i + 1];
+		}
+		shuffle(&rng, weights, items);
+	} else if (strcmp(class_name, "falkenauer") == 0 || strcmp(class_name, "uniform") == 0) {
+		int low = 1;
+		int high = 1000;
+		capacity = 1000;
+		if (strcmp(class_name, "falkenauer") == 0) {
+			low = 20;
+			high = 100;
+			capacity = 150;
+		}
+		weights = malloc(items * sizeof(int));
+		for (int i = 0; i < items; i++) {
+			weights[i] = low + random_num(&rng, high - low);
+		}
+	} else {
+		fprintf(stderr, "Error: unknown instance class %s (uniform, triplet or falkenauer).\n", class_name);
+		return -1;
+	}
+
+	char default_name[64];
+	if (output_name == NULL) {
+		snprintf(default_name, sizeof(default_name), "%s_%d.txt", class_name, items);
+		output_name = default_name;
+	}
+
+	FILE *fp;
+	if ((fp = fopen(output_name, "w")) == NULL) {
+		fprintf(stderr, "ERROR in writing to instance file %s\n", output_name);
+		free(weights);
+		return -1;
+	}
+	fprintf(fp, "%d\n%d\n", capacity, items);
+	for (int i = 0; i < items; i++) {
+		fprintf(fp, "%d\n", weights[i]);
+	}
+	fclose(fp);
+	free(weights);
+	printf("Instance stored in: %s\n", output_name);
+	return 0;
+}
+
+// Writes the outcome of a benchmark run as JSON: throughput, where the time went, and the best
+// number of bins after every generation
+void write_benchmark(FILE *fp, char *file_name, instance_t *instance, options_t *options, int ranks, result_t *result) {
+	char *phases[PHASES] = { "selection", "crossover", "mutation", "evaluation", "survivors" };
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"instance\": ");
+	write_json_string(fp, file_name);
+	fprintf(fp, ",\n  \"items\": %d,\n  \"seed\": %llu,\n", instance->size, (unsigned long long) options->seed);
+	fprintf(fp, "  \"ranks\": %d,\n  \"threads\": %d,\n  \"population\": %d,\n  \"decoder\": \"%s\",\n  \"simd\": \"%s\",\n",
+			ranks, options->threads, POP_SIZE, options->decoder_name, options->simd_name);
+	fprintf(fp, "  \"generations\": %d,\n  \"evaluations\": %lld,\n  \"runtime_s\": %.6f,\n", result->generations,
+			result->evaluations, result->runtime);
+	fprintf(fp, "  \"generations_per_s\": %.3f,\n  \"evaluations_per_s\": %.3f,\n", result->generations / result->runtime,
+			result->evaluations / result->runtime);
+	fprintf(fp, "  \"bins\": %d,\n  \"lower_bound\": %d,\n", result->bins, instance->lower_bound);
+
+	fprintf(fp, "  \"phase_thread_s\": {");
+	for (int phase = 0; phase < PHASES; phase++) {
+		fprintf(fp, "\"%s\": %.6f%s", phases[phase], result->phase_time[phase], phase + 1 < PHASES ? ", " : "");
+	}
+	fprintf(fp, "},\n");
+
+	fprintf(fp, "  \"convergence\": [");
+	for (int gen = 0; gen <= result->generations; gen++) {
+		fprintf(fp, "%d%s", result->curve[gen], gen < result->generations ? ", " : "");
+	}
+	fprintf(fp, "]\n}\n");
+}
+
+int main(int argc, char** argv) {
+	// Every island runs OpenMP threads, but only the main thread ever calls MPI
+	int rank, ranks, provided;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+	if (provided < MPI_THREAD_FUNNELED) {
+		fprintf(stderr, "Error: the MPI library does not support threads (MPI_THREAD_FUNNELED).\n");
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+	// Ensures the user specifies at least the input file (or a batch manifest)
+	if (argc < 2) {
+		fprintf(stderr, "Specify command line arguments as ./a.out [input file | --batch manifest] [--output results.csv|json] "
+				"[--benchmark] [--generate uniform|triplet|falkenauer --items N] "
+				"[--seed N] [--threads N] [--decoder next|first|best] [--simd auto|avx512|avx2|scalar] [--generations N] [--time-limit SECONDS] "
+				"[--topology ring|random] [--migration-interval N] [--migrants N]\n");
+		exit(EXIT_FAILURE);
+	}
+	char *file_name = NULL;
+	char *manifest_name = NULL;
+	char *output_name = NULL;
+	char *class_name = NULL;
+	int items = 1000;
+	int seed_given = 0;
+	int generations_given = 0;
+
+	// Without an explicit seed, runs are not reproducible
+	options_t options;
+	options.seed = clock() * time(NULL) * getpid();
+	options.threads = omp_get_max_threads();
+	options.generations = END_GEN;
+	options.time_limit = 0;
+	options.topology = TOPOLOGY_RING;
+	options.migration_interval = MIGRATION_INTERVAL;
+	options.migrants = MIGRANTS;
+	options.benchmark = 0;
+	options.decoder_name = "next";
+	options.simd_name = select_simd("auto");
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+			manifest_name = argv[++i];
+		} else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			output_name = argv[++i];
+		} else if (strcmp(argv[i], "--benchmark") == 0) {
+			options.benchmark = 1;
+		} else if (strcmp(argv[i], "--generate") == 0 && i + 1 < argc) {
+			class_name = argv[++i];
+		} else if (strcmp(argv[i], "--items") == 0 && i + 1 < argc) {
+			items = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			options.seed = strtoull(argv[++i], NULL, 10);
+			seed_given = 1;
+		} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			options.threads = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--decoder") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "first") == 0) {
+				decoder = first_fit;
+				options.decoder_name = "first";
+			} else if (strcmp(argv[i], "best") == 0) {
+				decoder = best_fit;
+				options.decoder_name = "best";
+			} else if (strcmp(argv[i], "next") == 0) {
+				decoder = next_fit;
+				options.decoder_name = "next";
+			} else {
+				fprintf(stderr, "Unknown decoder: %s (next, first or best)\n", argv[i]);
+				exit(EXIT_FAILURE);
+			}
+		} else if (strcmp(argv[i], "--simd") == 0 && i + 1 < argc) {
+			options.simd_name = select_simd(argv[++i]);
+			if (options.simd_name == NULL) {
+				fprintf(stderr, "Unknown instruction set: %s (auto, avx512, avx2 or scalar)\n", argv[i]);
+				exit(EXIT_FAILURE);
+			}
+		} else if (strcmp(argv[i], "--generations") == 0 && i + 1 < argc) {
+			options.generations = atoi(argv[++i]);
+			generations_given = 1;
+		} else if (strcmp(argv[i], "--time-limit") == 0 && i + 1 < argc) {
+			options.time_limit = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--topology") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "ring") == 0) {
+				options.topology = TOPOLOGY_RING;
+			} else if (strcmp(argv[i], "random") == 0) {
+				options.topology = TOPOLOGY_RANDOM;
+			} else {
+				fprintf(stderr, "Unknown topology: %s (ring or random)\n", argv[i]);
+				exit(EXIT_FAILURE);
+			}
+		} else if (strcmp(argv[i], "--migration-interval") == 0 && i + 1 < argc) {
+			options.migration_interval = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--migrants") == 0 && i + 1 < argc) {
+			options.migrants = atoi(argv[++i]);
+		} else if (argv[i][0] != '-' && file_name == NULL) {
+			file_name = argv[i];
+		} else {
+			fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (options.threads < 1) {
+		options.threads = 1;
+	}
+	if (options.migration_interval < 1) {
+		options.migration_interval = 1;
+	}
+	if (options.migrants < 0 || options.migrants > POP_SIZE) {
+		options.migrants = MIGRANTS;
+	}
+
+	// Benchmark runs and generated instances are reproducible by default
+	if (options.benchmark || class_name != NULL) {
+		if (!seed_given) {
+			options.seed = BENCHMARK_SEED;
+		}
+		if (!generations_given) {
+			options.generations = BENCHMARK_GENERATIONS;
+		}
+	}
+	if (options.generations < 0) {
+		options.generations = 0;
+	}
+
+	// Generator mode only writes an instance file
+	if (class_name != NULL) {
+		int status = rank == 0 ? generate_instance(class_name, items, options.seed, output_name) : 0;
+		MPI_Finalize();
+		return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	// Every island uses the master's seed so the whole run is reproducible
+	MPI_Bcast(&options.seed, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+	// Batch mode spreads whole instances over the threads of a single process
+	if (manifest_name != NULL) {
+		if (ranks > 1) {
+			fprintf(stderr, "Batch mode runs on a single MPI rank.\n");
+			exit(EXIT_FAILURE);
+		}
+		solve_batch(manifest_name, output_name != NULL ? output_name : "BIN_PACKER_RESULTS.csv", &options);
+		MPI_Finalize();
+		return 0;
+	}
+
+	if (file_name == NULL) {
+		fprintf(stderr, "Specify an input file or a batch manifest.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	instance_t instance;
+	if (load_instance(&instance, file_name) != 0) {
+		exit(EXIT_FAILURE);
+	}
+
+	result_t result;
+	solve(&instance, &options, rank, ranks, &result);
+
+	// Benchmark runs report as JSON, to the output file when one is given
+	if (options.benchmark) {
+		if (rank == 0) {
+			FILE *fp = output_name != NULL ? fopen(output_name, "w") : stdout;
+			if (fp == NULL) {
+				fprintf(stderr, "ERROR in writing to results file %s\n", output_name);
+				exit(EXIT_FAILURE);
+			}
+			write_benchmark(fp, file_name, &instance, &options, ranks, &result);
+			if (fp != stdout) {
+				fclose(fp);
+			}
+		}
+	} else if (rank == 0) {
+		printf("Most fit found: %d\n", result.bins);
+		printf("Lower bound: %d (L1 %d, L2 %d), gap %d\n", instance.lower_bound, instance.l1, instance.l2, result.bins - instance.lower_bound);
+		printf("Stopped after %d generations in %.3f s: %s\n", result.generations, result.runtime, result.reason);
+	}
+
+	free(result.curve);
+	free_instance(&instance);
 
+	MPI_Finalize();
 	return 0;
 }